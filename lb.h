@@ -0,0 +1,2850 @@
+/* The enumerator of lb.C as a header-only library: the search for the list
+ * of braids of one genus (see lb.C for what the list contains), its
+ * parallel and sharded variants, and the output formats. A program that
+ * wants the braids themselves rather than the printed list can use
+ *    visitBraids(genus, visit)
+ * (see below), which hands every braid of the list to visit() without
+ * printing or copying it.
+ */
+#ifndef LB_H
+#define LB_H
+
+#include<vector>
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<cerrno>
+#include<atomic>
+#include<condition_variable>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<fcntl.h>
+#include<initializer_list>
+#include<iterator>
+#include<fstream>
+#include<string>
+#include<stdint.h>
+#include<mutex>
+#include<thread>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unordered_map>
+#include<unistd.h>
+#include<cmath>
+#include<random>
+
+const bool debug = false;
+
+/* A braid word of at most capacity letters, where the letter i >= 1 stands
+ * for the Artin generator sigma_i. The letters are stored inline as bytes,
+ * so that the search does not touch the heap, a braid fits into a single
+ * cache line, and braids are compared by memcmp rather than letter by
+ * letter. It offers the parts of the interface of std::vector that are
+ * used below.
+ */
+class braidWord {
+    public:
+        static const size_t capacity = 63;
+        typedef uint8_t *iterator;
+        typedef const uint8_t *const_iterator;
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+        braidWord() : length(0) {
+            memset(letters, 0, capacity);
+        }
+
+        braidWord(std::initializer_list<int> l) : length(0) {
+            memset(letters, 0, capacity);
+            for (std::initializer_list<int>::const_iterator i = l.begin();
+                    i != l.end(); ++i)
+                push_back(*i);
+        }
+
+        size_t size() const { return length; }
+        bool empty() const { return length == 0; }
+        void push_back(int letter) { letters[length++] = letter; }
+        void pop_back() { --length; }
+        uint8_t &back() { return letters[length - 1]; }
+        uint8_t back() const { return letters[length - 1]; }
+        const uint8_t *data() const { return letters; }
+        uint8_t &at(size_t i) { return letters[i]; }
+        uint8_t at(size_t i) const { return letters[i]; }
+        iterator begin() { return letters; }
+        iterator end() { return letters + length; }
+        const_iterator begin() const { return letters; }
+        const_iterator end() const { return letters + length; }
+        const_reverse_iterator rbegin() const {
+            return const_reverse_iterator(end());
+        }
+        const_reverse_iterator rend() const {
+            return const_reverse_iterator(begin());
+        }
+
+        bool operator==(const braidWord &other) const {
+            return (length == other.length) &&
+                !memcmp(letters, other.letters, length);
+        }
+        bool operator!=(const braidWord &other) const {
+            return !(*this == other);
+        }
+        // Lexicographic order, with prefixes first, as in the search.
+        bool operator<(const braidWord &other) const {
+            const int c = memcmp(letters, other.letters,
+                    std::min(length, other.length));
+            return (c < 0) || ((c == 0) && (length < other.length));
+        }
+
+    private:
+        // The length comes last, so that a braid can be read as 64 bytes
+        // starting at its first letter.
+        uint8_t letters[capacity];
+        uint8_t length;
+};
+
+/* Scanning kernels: rangeMask(b, lo, n) has bit i set if and only if
+ * lo <= b.at(i) < lo + n. The braid is compared as a whole with SSE2 or
+ * AVX2 where the processor has it, which is decided once at startup.
+ */
+inline uint64_t rangeMaskScalar(const braidWord &b, int lo, int n) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < b.size(); ++i)
+        if ((uint8_t)(b.at(i) - lo) < n)
+            result |= (uint64_t)1 << i;
+    return result;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include<immintrin.h>
+
+inline __attribute__((target("sse2")))
+uint64_t rangeMaskSSE2(const braidWord &b, int lo, int n) {
+    const __m128i low = _mm_set1_epi8(lo);
+    const __m128i high = _mm_set1_epi8(n - 1);
+    uint64_t result = 0;
+    for (int i = 0; i < 4; ++i) {
+        const __m128i d = _mm_sub_epi8(_mm_loadu_si128(
+                    (const __m128i *)(b.data() + 16 * i)), low);
+        result |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_min_epu8(d, high), d)) << (16 * i);
+    }
+    return result & (((uint64_t)1 << b.size()) - 1);
+}
+
+inline __attribute__((target("avx2")))
+uint64_t rangeMaskAVX2(const braidWord &b, int lo, int n) {
+    const __m256i low = _mm256_set1_epi8(lo);
+    const __m256i high = _mm256_set1_epi8(n - 1);
+    uint64_t result = 0;
+    for (int i = 0; i < 2; ++i) {
+        const __m256i d = _mm256_sub_epi8(_mm256_loadu_si256(
+                    (const __m256i *)(b.data() + 32 * i)), low);
+        result |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_min_epu8(d, high), d)) << (32 * i);
+    }
+    return result & (((uint64_t)1 << b.size()) - 1);
+}
+#endif
+
+typedef uint64_t (*rangeMaskFunction)(const braidWord &, int, int);
+
+inline rangeMaskFunction chooseRangeMask() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return rangeMaskAVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return rangeMaskSSE2;
+#endif
+    return rangeMaskScalar;
+}
+
+const rangeMaskFunction rangeMask = chooseRangeMask();
+
+inline int highestBit(uint64_t x) {
+    return 63 - __builtin_clzll(x);
+}
+
+inline int lowestBit(uint64_t x) {
+    return __builtin_ctzll(x);
+}
+
+/* The number of twist regions of a column, given the positions of its two
+ * letters as bitmasks a and b: one plus the number of changes between a
+ * and b when going through the positions in a | b. To find the changes,
+ * every position is filled with the letter at the last position in a | b
+ * before or at it: adding the positions of b to the positions not in a
+ * carries every letter b upwards to the next letter a.
+ */
+inline int twistRegions(uint64_t a, uint64_t b) {
+    const uint64_t notA = ~a, notB = ~b;
+    const uint64_t fillA = (((notB + a) ^ notB) & notB) | a;
+    const uint64_t fillB = (((notA + b) ^ notA) & notA) | b;
+    return __builtin_popcountll((a & (fillB << 1)) | (b & (fillA << 1))) +
+        ((a | b) != 0);
+}
+
+// The finalizer of splitmix64.
+inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+inline int max(const braidWord &b) {
+    int result = 1;
+    for (braidWord::const_iterator i = b.begin(); i != b.end(); ++i)
+        if (*i > result)
+            result = *i;
+    return result;
+}
+
+// Where an outputBuffer can hand its contents instead of to a file
+// descriptor.
+class outputSink {
+    public:
+        virtual ~outputSink() {}
+        virtual void write(const char *data, size_t n) = 0;
+};
+
+/* An output file written through a memory map instead of write(2). The
+ * file grows by windows of fixed size, which are allocated on disk in one
+ * piece with fallocate() where the file system supports it, and mapped one
+ * at a time while they are written. close() truncates the file to the
+ * bytes actually written.
+ */
+class mappedOutput : public outputSink {
+    public:
+        static const size_t window = (size_t)64 << 20;
+
+        mappedOutput() : fd(-1), map(0), start(0), used(0) {}
+
+        // Returns false if the file cannot be created.
+        bool open(const char *file) {
+            fd = ::open(file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            return (fd >= 0) && mapWindow();
+        }
+
+        void write(const char *data, size_t n) override {
+            while (n > 0) {
+                if (used == window) {
+                    munmap(map, window);
+                    start += window;
+                    used = 0;
+                    if (!mapWindow())
+                        fail();
+                }
+                const size_t chunk = std::min(n, window - used);
+                memcpy(map + used, data, chunk);
+                used += chunk;
+                data += chunk;
+                n -= chunk;
+            }
+        }
+
+        void close() {
+            if (munmap(map, window) || ftruncate(fd, start + used) ||
+                    ::close(fd))
+                fail();
+        }
+
+    private:
+        int fd;
+        char *map;
+        off_t start;
+        size_t used;
+
+        bool mapWindow() {
+#ifdef __linux__
+            if (fallocate(fd, 0, start, window) &&
+                    ftruncate(fd, start + window))
+                return false;
+#else
+            if (ftruncate(fd, start + window))
+                return false;
+#endif
+            map = (char *)mmap(0, window, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, start);
+            return map != MAP_FAILED;
+        }
+
+        void fail() {
+            std::cerr << "Writing the output failed.\n";
+            exit(1);
+        }
+};
+
+/* Output goes through a large buffer, which is handed to write(2) in big
+ * chunks instead of streaming every token through std::cout. A buffer
+ * without file descriptor (fd = -1) or sink just grows, which the
+ * worker threads of the parallel search use. They do not know the numbers
+ * of their braids yet, so they leave the counters out, mark where they
+ * belong, and copy() fills them in later. If sink is not null, the buffer
+ * goes there instead of to fd.
+ */
+class outputBuffer {
+    public:
+        outputBuffer(int fd = -1, outputSink *sink = 0)
+            : fd(fd), sink(sink),
+            buffer(((fd < 0) && !sink) ? 0 : (1 << 20)), used(0) {}
+
+        ~outputBuffer() {
+            flush();
+        }
+
+        void put(char c) {
+            if (used == buffer.size())
+                reserve(1);
+            buffer[used++] = c;
+        }
+
+        void put(const char *s, size_t n) {
+            memcpy(reserve(n), s, n);
+            used += n;
+        }
+
+        void put(const char *s) {
+            put(s, strlen(s));
+        }
+
+        void putInt(int64_t x) {
+            char digits[24];
+            char *p = digitsOf((x < 0) ? -(uint64_t)x : x,
+                    digits + sizeof(digits));
+            if (x < 0)
+                *--p = '-';
+            put(p, digits + sizeof(digits) - p);
+        }
+
+        void putUnsigned(uint64_t u) {
+            char digits[24];
+            char *p = digitsOf(u, digits + sizeof(digits));
+            put(p, digits + sizeof(digits) - p);
+        }
+
+        // Takes back the last character, which is always still in the
+        // buffer, since it is flushed only before putting more.
+        void unput() {
+            --used;
+        }
+
+        void markCounter() {
+            marks.push_back(used);
+        }
+
+        // Appends the contents of other, with consecutive counters from
+        // counter + 1 at the marks.
+        void copy(const outputBuffer &other, uint64_t &counter) {
+            size_t from = 0;
+            for (std::vector<size_t>::const_iterator i = other.marks.begin();
+                    i != other.marks.end(); ++i) {
+                put(other.buffer.data() + from, *i - from);
+                putUnsigned(++counter);
+                from = *i;
+            }
+            put(other.buffer.data() + from, other.used - from);
+        }
+
+        // The contents of a buffer without file descriptor.
+        const char *data() const {
+            return buffer.data();
+        }
+
+        size_t size() const {
+            return used;
+        }
+
+        // Empties a buffer without file descriptor, keeping its memory.
+        void clear() {
+            used = 0;
+            marks.clear();
+        }
+
+        void swap(outputBuffer &other) {
+            std::swap(fd, other.fd);
+            std::swap(sink, other.sink);
+            buffer.swap(other.buffer);
+            std::swap(used, other.used);
+            marks.swap(other.marks);
+        }
+
+        void flush() {
+            if (sink) {
+                sink->write(buffer.data(), used);
+                used = 0;
+                return;
+            }
+            if (fd < 0)
+                return;
+            for (size_t done = 0; done < used; ) {
+                const ssize_t n = write(fd, &buffer.at(done), used - done);
+                if (n < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    std::cerr << "Writing the output failed.\n";
+                    exit(1);
+                }
+                done += n;
+            }
+            used = 0;
+        }
+
+    private:
+        int fd;
+        outputSink *sink;
+        std::vector<char> buffer;
+        size_t used;
+        std::vector<size_t> marks;
+
+        char *reserve(size_t n) {
+            if (used + n > buffer.size()) {
+                flush();
+                if (used + n > buffer.size())
+                    buffer.resize(std::max(2 * buffer.size(), used + n));
+            }
+            return &buffer.at(used);
+        }
+
+        // Writes the decimal digits of u, two at a time, backwards from
+        // end. Returns the first digit.
+        static char *digitsOf(uint64_t u, char *end) {
+            static const char pairs[] =
+                "0001020304050607080910111213141516171819"
+                "2021222324252627282930313233343536373839"
+                "4041424344454647484950515253545556575859"
+                "6061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+            char *p = end;
+            while (u >= 100) {
+                p -= 2;
+                memcpy(p, pairs + 2 * (u % 100), 2);
+                u /= 100;
+            }
+            if (u >= 10) {
+                p -= 2;
+                memcpy(p, pairs + 2 * u, 2);
+            } else
+                *--p = '0' + u;
+            return p;
+        }
+};
+
+// Reading counterpart of outputBuffer, for the binary format.
+class inputBuffer {
+    public:
+        inputBuffer(int fd) : fd(fd), buffer(1 << 20), used(0), read(0) {}
+
+        // Returns the next byte, or -1 at the end of the input.
+        int get() {
+            if (read == used) {
+                ssize_t n;
+                while (((n = ::read(fd, buffer.data(), buffer.size())) < 0) &&
+                        (errno == EINTR));
+                if (n <= 0)
+                    return -1;
+                used = n;
+                read = 0;
+            }
+            return (uint8_t)buffer[read++];
+        }
+
+    private:
+        int fd;
+        std::vector<char> buffer;
+        size_t used, read;
+};
+
+// needed only for DT-codes
+class intpair {
+    public:
+        int o, e;
+        bool s;
+};
+
+// Scratch space for printDT(), which is reused from call to call, so that
+// printing does not allocate.
+class dtScratch {
+    public:
+        intpair n[braidWord::capacity];
+        int dt[braidWord::capacity];
+};
+
+// Computes the DT-code of a positive braid into scratch.dt, returns false
+// if its closure is not a knot (which only braids that do not come from
+// the search can fail, see searchTree()).
+// The braid is given as a braid word v, where i >= 1 corresponds to
+// the sigma_i Artin generator
+inline bool computeDT(const braidWord &v, dtScratch &scratch) {
+    const int maxGen = max(v) - 1;
+    intpair *n = scratch.n;
+    int *dt = scratch.dt;
+    int passed = 0;
+    int c = 0;
+    int crossingCounter = 1;
+    do {
+        for (braidWord::const_iterator i = v.begin(); i != v.end(); ++i)
+            if ((*i == c) || (*i == (c + 1))) {
+                if (crossingCounter % 2)
+                    n[i - v.begin()].o = crossingCounter;
+                else
+                    n[i - v.begin()].e = crossingCounter;
+                n[i - v.begin()].s =
+                    (!(crossingCounter % 2)) == (!(*i == c + 1));
+                ++crossingCounter;
+                if (*i == c + 1)
+                    ++c;
+                else
+                    --c;
+            }
+        ++passed;
+    } while (c != 0);
+    if (passed != maxGen + 2)
+        return false;
+
+    // The odd labels are 1, 3, 5, ..., one for every crossing, so sorting
+    // the crossings by them just means putting the crossing with odd label
+    // o at position (o - 1) / 2.
+    for (size_t i = 0; i < v.size(); ++i)
+        dt[(n[i].o - 1) / 2] = n[i].e * (n[i].s ? 1 : -1);
+    return true;
+}
+
+// Prints ": n counter" and a DT-code of length n to out (none if dt is
+// null), leaving a mark instead of the counter if it is zero.
+inline void printDT(const int *dt, size_t n, uint64_t counter,
+        outputBuffer &out) {
+    out.put(": ");
+    out.putUnsigned(n);
+    out.put(' ');
+    if (counter)
+        out.putUnsigned(counter);
+    else
+        out.markCounter();
+    for (size_t j = 0; dt && (j < n); ++j) {
+        out.put(' ');
+        out.putInt(dt[j]);
+    }
+    out.put('\n');
+}
+
+// Prints ": n counter" and the DT-code of a positive braid to out, leaving
+// a mark instead of the counter if it is zero.
+inline bool printDT(const braidWord &v, uint64_t counter, dtScratch &scratch,
+        outputBuffer &out) {
+    if (!computeDT(v, scratch))
+        return false;
+    printDT(scratch.dt, v.size(), counter, out);
+    return true;
+}
+
+inline void printBraid(const braidWord &b, std::ostream& s = std::cout,
+        bool newline = true) {
+    for (braidWord::const_iterator i = b.begin(); i != b.end(); ++i)
+        s << (char)(*i + 96);
+    if (newline)
+        s << "\n";
+}
+
+inline void printBraid(const braidWord &b, outputBuffer &out) {
+    for (braidWord::const_iterator i = b.begin(); i != b.end(); ++i)
+        out.put((char)(*i + 96));
+}
+
+/* The last letter is too high if there are more strands then maxB1 + 1,
+ * or if the braid ends with sigma_i sigma_j, with j > i + 1.
+ */
+inline bool lastLetterTooHigh(const braidWord &b, int maxB1) {
+    if (b.size() < 2)
+        return false;
+    return (b.back() > 1 + *std::max_element(b.begin(), b.end() - 1));
+}
+
+inline int numberOfComponents(const braidWord &b) {
+    if (b.empty())
+        return 0;
+    std::vector<int> compNumber(max(b) + 1, 0);
+    std::vector<int>::iterator i = compNumber.begin();
+    int compCounter = 0;
+    while (i != compNumber.end()) {
+        compCounter += 1;
+        while (*i == 0) {
+            *i = compCounter;
+            int currentPos = i - compNumber.begin() + 1;
+            for (braidWord::const_iterator j = b.begin();
+                    j != b.end(); ++j) {
+                if (*j == currentPos)
+                    currentPos += 1;
+                else if (*j == currentPos - 1)
+                    currentPos -= 1;
+            }
+            i = compNumber.begin() + (currentPos - 1);
+        }
+        for (; (i != compNumber.end()) && (*i != 0); ++i);
+    }
+    return compCounter;
+}
+
+inline int b1(const braidWord &b) {
+    return 1 + b.size() - (max(b) + 1);
+}
+
+/* Bit j of positions[i] is set if the letter j of b is i, for i up to
+ * max(b) + 1.
+ */
+inline void positionMasks(const braidWord &b, uint64_t *positions) {
+    std::fill(positions, positions + max(b) + 2, 0);
+    for (size_t j = 0; j < b.size(); ++j)
+        positions[b.at(j)] |= (uint64_t)1 << j;
+}
+
+inline int missingCrossingsForPrimality(const braidWord &b) {
+    const int columns = max(b);
+    uint64_t positions[256];
+    positionMasks(b, positions);
+    // Each column i - 1 with fewer than four twist regions, and each column
+    // i with two, leaves out a crossing for primality, counted once per i.
+    int result = 0;
+    bool missingHere = false;
+    for (int i = 1; i < columns; ++i) {
+        const int twistRegions =
+            ::twistRegions(positions[i], positions[i + 1]);
+        if (debug && (twistRegions < 2))
+            throw;
+        result += (missingHere || (twistRegions == 2));
+        missingHere = (twistRegions < 4);
+    }
+    return result + missingHere;
+}
+
+// Returs true if the braid is the lexicographic minimimum among all its
+// cyclic conjugates, or at least a prefix of such a braid: no suffix is
+// lexicographically smaller than the prefix of the same length. This is
+// Duval's test for pre-necklaces, which runs in linear time: period is the
+// length of the longest Lyndon word which the braid read so far is a prefix
+// of a power of.
+inline bool lexicoGood(const braidWord &b) {
+    size_t period = 1;
+    for (size_t j = 1; j < b.size(); ++j) {
+        if (b.at(j) < b.at(j - period))
+            return false;
+        if (b.at(j) > b.at(j - period))
+            period = j + 1;
+    }
+    return true;
+}
+
+// The rule of reidemeister() for a letter s following the letters of b,
+// given the positions in b of the letters s - 1, s and s + 1 as the mask
+// near.
+inline bool reidemeisterGood(const braidWord &b, int s, uint64_t near) {
+    if (near == 0)
+        return true;
+    int i = highestBit(near);
+    if ((b.at(i) == s) || (b.at(i) == s + 1))
+        return true;
+    near &= ~((uint64_t)1 << i);
+    if (near == 0)
+        return true;
+    i = highestBit(near);
+    return (b.at(i) == s - 1) || (b.at(i) == s + 1);
+}
+
+/* Looks at the last two letters before the last letter s which do not
+ * commute with it, i.e. which are s - 1, s or s + 1, and returns false if
+ * they allow to make the braid smaller by a braid-like Reidemeister-III
+ * move.
+ */
+inline bool reidemeister(const braidWord &b) {
+    const int s = b.back();
+    return reidemeisterGood(b, s, rangeMask(b, s - 1, 3) &
+            (((uint64_t)1 << (b.size() - 1)) - 1));
+}
+
+/* Checks if the braid can be completed to an admissible braid word
+ * of B1 = maxB1 by adding further letters.
+ */
+inline int completable(const braidWord &b, int maxB1) {
+    return (numberOfComponents(b) - (maxB1 - b1(b)) <= 1) +
+           2 * (missingCrossingsForPrimality(b) <= (maxB1 - b1(b))) +
+           4 * lexicoGood(b) + 
+           8 * reidemeister(b);
+}
+
+/* Optional rules pruning the search tree further, so that the list contains
+ * fewer doubles:
+ *  - symmetry: a braid is only listed if it is not bigger than any rotation
+ *    of its reverse, of its flip (with sigma_i replaced by sigma_{n-i} for
+ *    n = max + 1) or of the reverse of its flip. These all give the same
+ *    knot, up to orientation, and as the smallest braid of a knot among
+ *    all of them is still listed, no knot is lost.
+ *  - commutation: a braid is only listed if no rotation of it can be made
+ *    smaller by commuting far generators (its trace, in the sense of
+ *    Cartier and Foata, is smallest among those of its rotations).
+ *    Without rotations, this already follows from appendLetter() never
+ *    appending a letter smaller than the last one minus 1: no factor b u a
+ *    with a < b commuting with b and u is left, so every part of the braid
+ *    is the smallest braid it can be commuted into, and lexicoGood()
+ *    compares it with the start of the braid. Only the rotations wrapping
+ *    around the end can be smaller, so this is checked for the whole braid.
+ */
+class searchRules {
+    public:
+        bool symmetry;
+        bool commutation;
+
+        searchRules() : symmetry(false), commutation(false) {}
+
+        // Whether any of the rules is used.
+        bool any() const {
+            return symmetry || commutation;
+        }
+};
+
+/* Compares the smallest braid that the n letters starting with b[from]
+ * (cyclically) can be turned into by commuting far generators with the
+ * first n letters of b: negative if smaller, 0 if equal, positive if bigger.
+ * The smallest braid is built letter by letter, each time taking the
+ * smallest letter that can be commuted to the front of the rest.
+ */
+inline int compareCommuted(const braidWord &b, size_t from, size_t n) {
+    uint8_t rest[braidWord::capacity];
+    for (size_t i = 0; i < n; ++i)
+        rest[i] = b.at((from + i) % b.size());
+    for (size_t t = 0; t < n; ++t) {
+        // A letter can be commuted to the front if no letter before it is
+        // the same or a neighbour.
+        uint64_t before = 0;
+        size_t best = 0;
+        for (size_t i = 0; i < n - t; ++i) {
+            if ((((before >> rest[i]) & 7) == 0) && ((before == 0) ||
+                        (rest[i] < rest[best])))
+                best = i;
+            before |= (uint64_t)2 << rest[i];
+        }
+        if (rest[best] != b.at(t))
+            return rest[best] - b.at(t);
+        memmove(rest + best, rest + best + 1, n - t - best - 1);
+    }
+    return 0;
+}
+
+// Whether the braid is listed with the commutation rule of searchRules.
+inline bool commutationGood(const braidWord &b) {
+    // The smallest braid that the rotation starting at j can be made into
+    // starts with 1 = b.at(0) only if a 1 comes before all 2s in it, which
+    // is what low is about. Since b.at(0) = 1, low is 1 for j = size.
+    int low = 1;
+    for (size_t j = b.size() - 1; j > 0; --j) {
+        if (b.at(j) <= 2)
+            low = b.at(j);
+        if ((low == 1) && (compareCommuted(b, j, b.size()) < 0))
+            return false;
+    }
+    return true;
+}
+
+// Whether no rotation of v is smaller than w (which has the same length).
+inline bool noSmallerRotation(const braidWord &w, const braidWord &v) {
+    const size_t n = w.size();
+    for (size_t r = 0; r < n; ++r)
+        for (size_t i = 0; i < n; ++i) {
+            const int x = v.at((r + i) % n);
+            if (x != w.at(i)) {
+                if (x < w.at(i))
+                    return false;
+                break;
+            }
+        }
+    return true;
+}
+
+// Whether the braid is listed with the symmetry rule of searchRules.
+inline bool symmetryGood(const braidWord &b) {
+    const int n = max(b) + 1;
+    braidWord reversed, flipped, both;
+    for (braidWord::const_iterator i = b.begin(); i != b.end(); ++i)
+        flipped.push_back(n - *i);
+    for (braidWord::const_reverse_iterator i = b.rbegin(); i != b.rend();
+            ++i) {
+        reversed.push_back(*i);
+        both.push_back(n - *i);
+    }
+    return noSmallerRotation(b, reversed) && noSmallerRotation(b, flipped) &&
+        noSmallerRotation(b, both);
+}
+
+// Whether an admissible braid is listed with the rules.
+inline bool rulesGood(const searchRules &rules, const braidWord &b) {
+    return (!rules.symmetry || symmetryGood(b)) &&
+        (!rules.commutation || commutationGood(b));
+}
+
+// A 128-bit hash of a sequence of bytes, taken eight at a time.
+class byteHash {
+    public:
+        uint64_t low, high;
+
+        byteHash() : low(0), high(0) {}
+
+        byteHash(const uint8_t *bytes, size_t n)
+            : low(0x6c62272e07bb0142ull ^ n), high(0x9e3779b97f4a7c15ull) {
+            for (size_t i = 0; i < n; i += 8) {
+                uint64_t word = 0;
+                memcpy(&word, bytes + i, std::min(n - i, (size_t)8));
+                low = mix64(low ^ word);
+                high = mix64(high + word * 0x9e3779b97f4a7c15ull);
+            }
+        }
+};
+
+/* The braid of the depth-first search together with everything about it
+ * that completable() needs, updated letter by letter rather than recomputed
+ * from the whole braid at every node: the maximal generator of every
+ * prefix, the period of every prefix in lexicoGood() (with 0 once a prefix
+ * is not lexicographically good any more), the permutation of the strands
+ * and the number of its cycles for every prefix, and for every column i
+ * the number of twist regions (maximal runs of the same letter in the
+ * subsequence of letters i and i+1) together with the last letter in it.
+ * Like the braid, all of it is stored inline.
+ *
+ * The state is compiled separately for every maxB1, which bounds the braids
+ * of the search: a completable braid has at most maxB1 + 1 generators (as
+ * a generator occurring only once needs a missing crossing next to it), so
+ * the search has letters up to maxB1 + 3 (too high by two before popping
+ * back) and at most 2 * maxB1 + 1 letters. This makes all the arrays small,
+ * and turns maxB1 into a constant throughout the search.
+ */
+template<int MaxB1>
+class searchState {
+    public:
+        static const int maxB1 = MaxB1;
+        braidWord braid;
+        searchRules rules;
+
+        searchState(const braidWord &b, const searchRules &rules)
+            : rules(rules) {
+            maxes[0] = 1;
+            periods[0] = 1;
+            cycles[0] = 2;
+            for (size_t i = 0; i < strands; ++i) {
+                strandAt[i] = i;
+                regions[i] = 0;
+                lastInColumn[i] = 0;
+                positions[i] = 0;
+            }
+            for (braidWord::const_iterator i = b.begin(); i != b.end(); ++i)
+                push(*i);
+        }
+
+        void push(int letter) {
+            if (debug && ((braid.size() >= length) || (letter > MaxB1 + 3)))
+                throw;
+            braid.push_back(letter);
+            const size_t j = braid.size() - 1;
+            maxes[j + 1] = std::max((int)maxes[j], letter);
+            int period = periods[j];
+            if ((period != 0) && (j > 0)) {
+                if (letter < braid.at(j - period))
+                    period = 0;
+                else if (letter > braid.at(j - period))
+                    period = j + 1;
+            }
+            periods[j + 1] = period;
+            positions[letter] |= (uint64_t)1 << j;
+            // New strands are cycles of their own. Swapping two entries of
+            // the permutation splits their cycle if they are in the same one,
+            // and joins their cycles otherwise.
+            int k = strandAt[letter];
+            while ((k != letter) && (k != letter + 1))
+                k = strandAt[k];
+            cycles[j + 1] = cycles[j] + (maxes[j + 1] - maxes[j]) +
+                ((k == letter) ? -1 : 1);
+            std::swap(strandAt[letter], strandAt[letter + 1]);
+            for (int i = letter - 1; i <= letter; ++i) {
+                undo[2 * j + letter - i] = lastInColumn[i];
+                if (lastInColumn[i] != letter) {
+                    lastInColumn[i] = letter;
+                    ++regions[i];
+                }
+            }
+        }
+
+        void pop() {
+            const int letter = braid.back();
+            const size_t j = braid.size() - 1;
+            for (int i = letter - 1; i <= letter; ++i)
+                if (lastInColumn[i] != undo[2 * j + letter - i]) {
+                    lastInColumn[i] = undo[2 * j + letter - i];
+                    --regions[i];
+                }
+            std::swap(strandAt[letter], strandAt[letter + 1]);
+            positions[letter] &= ~((uint64_t)1 << j);
+            braid.pop_back();
+        }
+
+        // Does braid.back() += 1.
+        void increase() {
+            const int letter = braid.back();
+            pop();
+            push(letter + 1);
+        }
+
+        // The maximal generator among the first n letters (at least 1).
+        int maxOfFirst(size_t n) const {
+            return maxes[n];
+        }
+
+        // Same as lexicoGood(braid), in constant time.
+        bool lexicoGood() const {
+            return periods[braid.size()] != 0;
+        }
+
+        int b1() const {
+            return 1 + braid.size() - (maxes[braid.size()] + 1);
+        }
+
+        // The number of cycles of the permutation of the max + 1 strands.
+        int components() const {
+            return braid.empty() ? 0 : cycles[braid.size()];
+        }
+
+        // Whether the braid read backwards is not smaller than the braid.
+        // If it is, then so is the rotation of the reverse of every longer
+        // braid starting with this one that starts at the current last
+        // letter, so that the symmetry rule of searchRules prunes it.
+        bool reverseGood() const {
+            for (size_t i = 0, j = braid.size() - 1; i < j; ++i, --j)
+                if (braid.at(i) != braid.at(j))
+                    return braid.at(j) > braid.at(i);
+            return true;
+        }
+
+        // Same as missingCrossingsForPrimality(braid).
+        int missingCrossings() const {
+            const int columns = maxes[braid.size()];
+            int result = 0;
+            bool missingHere = false;
+            for (int i = 1; i < columns; ++i) {
+                if (debug && (regions[i] !=
+                            twistRegions(positions[i], positions[i + 1])))
+                    throw;
+                result += (missingHere || (regions[i] == 2));
+                missingHere = (regions[i] < 4);
+            }
+            return result + missingHere;
+        }
+
+        // Same as reidemeister(braid), finding the letters that do not
+        // commute with the last one in the masks of their positions.
+        bool reidemeister() const {
+            const size_t j = braid.size() - 1;
+            const int s = braid.back();
+            return reidemeisterGood(braid, s, (positions[s - 1] |
+                        positions[s] | positions[s + 1]) &
+                    (((uint64_t)1 << j) - 1));
+        }
+
+        /* For a completable braid with b1() == maxB1 - 1, whose children
+         * with a last letter x up to the max are all of b1() == maxB1: the
+         * letters x for which the child is completable (and so admissible
+         * up to the rules), as bit x of the result. All four conditions of
+         * completable() are evaluated for all children at once as masks
+         * over x, from the state of this braid alone:
+         *  - lexicoGood(): x is at least the letter a period back,
+         *  - components(): the braid has two cycles, and x and x + 1 are
+         *    in different ones, so that appending x joins them,
+         *  - missingCrossings(): every column already has four twist
+         *    regions, except those x - 1 and x that x adds a fifth to,
+         *  - reidemeister(): reidemeisterGood() with the masks of the
+         *    positions, as there.
+         */
+        uint64_t leafMask() const {
+            const size_t n = braid.size();
+            const int m = maxes[n];
+            if ((cycles[n] != 2) || (periods[n] == 0))
+                return 0;
+            const int lowest = std::max((braid.back() == 1) ? 1 :
+                    (braid.back() - 1), (int)braid.at(n - periods[n]));
+            uint64_t result = (((uint64_t)2 << m) - 1) &
+                ~(((uint64_t)1 << lowest) - 1);
+            // The strands in the cycle of strand 1.
+            uint64_t cycle = 0;
+            int k = 1;
+            do {
+                cycle |= (uint64_t)1 << k;
+                k = strandAt[k];
+            } while (k != 1);
+            result &= cycle ^ (cycle >> 1);
+            // Bit x of fixers is set if x fixes all the short columns.
+            uint64_t fixers = ~(uint64_t)0;
+            for (int i = 1; (i < m) && result; ++i) {
+                if (regions[i] >= 4)
+                    continue;
+                if (regions[i] < 3)
+                    return 0;
+                fixers &= ((uint64_t)(lastInColumn[i] != i + 1) << (i + 1)) |
+                    ((uint64_t)(lastInColumn[i] != i) << i);
+            }
+            result &= fixers;
+            for (uint64_t left = result; left; left &= left - 1) {
+                const int x = lowestBit(left);
+                if (!reidemeisterGood(braid, x, positions[x - 1] |
+                            positions[x] | positions[x + 1]))
+                    result &= ~((uint64_t)1 << x);
+            }
+            return result;
+        }
+
+        /* A summary of everything the search tree below the braid depends on
+         * without searchRules, so that braids with the same summary have
+         * the same subtree up to their first letters (see deadPrefixes):
+         * the length, the max, the last letter and the period of
+         * lexicoGood(), the twist regions of the columns (so far as
+         * missingCrossings() tells them apart) with their last letters,
+         * the permutation, the last two letters reidemeister() would find
+         * for every next letter, and the letters that lexicoGood() may
+         * still compare the next ones with (after the period, or from the
+         * start if the period grows).
+         */
+        static const size_t summaryBytes = 7 * MaxB1 + 16;
+
+        // Writes the summary to key (of summaryBytes bytes), returns its
+        // length.
+        size_t summary(uint8_t *key) const {
+            const size_t n = braid.size();
+            const int m = maxes[n];
+            const size_t period = periods[n];
+            uint8_t *p = key;
+            *p++ = n;
+            *p++ = m;
+            *p++ = braid.back();
+            *p++ = period;
+            for (int i = 1; i <= m; ++i)
+                *p++ = std::min((int)regions[i], 4) * 3 +
+                    (lastInColumn[i] ? (lastInColumn[i] - i + 1) : 0);
+            memcpy(p, strandAt + 1, m + 1);
+            p += m + 1;
+            memset(p, 0, m + 2);
+            for (size_t j = n; j-- > 0; ) {
+                const int letter = braid.data()[j];
+                for (int c = std::max(letter - 1, 1); c <= letter + 1; ++c)
+                    if (p[c - 1] < 4)
+                        p[c - 1] = 4 * p[c - 1] + (letter - c + 2);
+            }
+            p += m + 1;
+            const size_t ahead = length - n;
+            const size_t last = std::min(ahead, period);
+            memcpy(p, braid.data() + n - period, last);
+            p += last;
+            memcpy(p, braid.data(), std::min(n, ahead));
+            p += std::min(n, ahead);
+            return p - key;
+        }
+
+        // Whether a braid (e.g. from a checkpoint) is within the bounds of
+        // completable braids, so that the search may continue from it.
+        static bool fits(const braidWord &b) {
+            return (b.size() < length) && (max(b) <= MaxB1 + 1);
+        }
+
+    private:
+        static const size_t length = 2 * MaxB1 + 1;
+        static const size_t strands = MaxB1 + 5;
+        static_assert(length <= braidWord::capacity, "maxB1 is too large.");
+        uint8_t maxes[length + 1];
+        uint8_t periods[length + 1];
+        uint8_t cycles[length + 1];
+        uint8_t strandAt[strands];
+        uint8_t regions[strands];
+        uint8_t lastInColumn[strands];
+        // Bit j of positions[i] is set if the letter j is i.
+        uint64_t positions[strands];
+        uint8_t undo[2 * length];
+};
+
+template<int MaxB1>
+bool lastLetterTooHigh(const searchState<MaxB1> &s) {
+    if (s.braid.size() < 2)
+        return false;
+    const bool result =
+        (s.braid.back() > 1 + s.maxOfFirst(s.braid.size() - 1));
+    if (debug && (result != lastLetterTooHigh(s.braid, MaxB1)))
+        throw;
+    return result;
+}
+
+// The search of width MaxB1 can also tell completability for a smaller
+// maxB1 (see listGenera()).
+template<int MaxB1>
+int completable(const searchState<MaxB1> &s, int maxB1 = MaxB1) {
+    const int result = (s.components() - (maxB1 - s.b1()) <= 1) +
+           2 * (s.missingCrossings() <= (maxB1 - s.b1())) +
+           4 * s.lexicoGood() +
+           8 * s.reidemeister();
+    if (debug && (result != completable(s.braid, maxB1)))
+        throw;
+    return result;
+}
+
+template<int MaxB1>
+void appendLetter(searchState<MaxB1> &s) {
+    s.push((s.braid.back() == 1) ? 1 : (s.braid.back() - 1));
+}
+
+/* Counters of the search tree for --stats, by braid length: the braids
+ * visited, those pruned because the last letter is too high, because
+ * (each of) the four conditions of completable() failed or by the rules of
+ * searchRules, the ones cut off for a subtree of their own and the
+ * admissible ones. In addition, the
+ * conditions are timed separately on every samplePeriod-th braid visited,
+ * to estimate the time spent on each of them.
+ */
+class searchStats {
+    public:
+        static const uint64_t samplePeriod = 1024;
+        static const int predicates = 5;
+        // The name of predicate i, in the order of the bits of
+        // completable().
+        static const char *name(int i) {
+            static const char *const names[predicates] = {
+                "components", "primality", "lexicoGood", "reidemeister",
+                "lastLetterTooHigh"
+            };
+            return names[i];
+        }
+        uint64_t visited[braidWord::capacity + 1];
+        uint64_t tooHigh[braidWord::capacity + 1];
+        uint64_t failed[4][braidWord::capacity + 1];
+        uint64_t pruned[braidWord::capacity + 1];
+        uint64_t split[braidWord::capacity + 1];
+        uint64_t admissible[braidWord::capacity + 1];
+        uint64_t samples;
+        double seconds[predicates];
+
+        searchStats() : samples(0), calls(0), overhead(0) {
+            memset(visited, 0, sizeof(visited));
+            memset(tooHigh, 0, sizeof(tooHigh));
+            memset(failed, 0, sizeof(failed));
+            memset(pruned, 0, sizeof(pruned));
+            memset(split, 0, sizeof(split));
+            memset(admissible, 0, sizeof(admissible));
+            std::fill(seconds, seconds + predicates, 0.0);
+        }
+
+        template<int MaxB1>
+        void visit(const searchState<MaxB1> &s) {
+            ++visited[s.braid.size()];
+            if ((++calls % samplePeriod) == 0)
+                sample(s);
+        }
+
+        void notCompletable(size_t length, int c) {
+            for (int i = 0; i < 4; ++i)
+                failed[i][length] += !(c & (1 << i));
+        }
+
+        void add(const searchStats &other) {
+            for (size_t i = 0; i <= braidWord::capacity; ++i) {
+                visited[i] += other.visited[i];
+                tooHigh[i] += other.tooHigh[i];
+                for (int j = 0; j < 4; ++j)
+                    failed[j][i] += other.failed[j][i];
+                pruned[i] += other.pruned[i];
+                split[i] += other.split[i];
+                admissible[i] += other.admissible[i];
+            }
+            samples += other.samples;
+            calls += other.calls;
+            for (int i = 0; i < predicates; ++i)
+                seconds[i] += other.seconds[i];
+            overhead += other.overhead;
+        }
+
+        // Writes the counters as JSON.
+        void print(int genus, std::ostream &out) const {
+            uint64_t total = 0, found = 0;
+            for (size_t i = 0; i <= braidWord::capacity; ++i) {
+                total += visited[i];
+                found += admissible[i];
+            }
+            out << "{\n  \"genus\": " << genus << ",\n  \"visited\": "
+                << total << ",\n  \"admissible\": " << found
+                << ",\n  \"lengths\": [";
+            bool first = true;
+            for (size_t i = 0; i <= braidWord::capacity; ++i) {
+                if (visited[i] == 0)
+                    continue;
+                out << (first ? "\n" : ",\n") << "    { \"length\": " << i
+                    << ", \"visited\": " << visited[i]
+                    << ", \"lastLetterTooHigh\": " << tooHigh[i];
+                for (int j = 0; j < 4; ++j)
+                    out << ", \"" << name(j) << "\": " << failed[j][i];
+                out << ", \"rules\": " << pruned[i] << ", \"split\": "
+                    << split[i] << ", \"admissible\": " << admissible[i]
+                    << " }";
+                first = false;
+            }
+            // The timer overhead is measured, too, and subtracted.
+            out << "\n  ],\n  \"samplePeriod\": " << samplePeriod
+                << ",\n  \"samples\": " << samples
+                << ",\n  \"estimatedSeconds\": {";
+            for (int i = 0; i < predicates; ++i)
+                out << (i ? ", " : " ") << "\"" << name(i) << "\": "
+                    << std::max(0.0, (seconds[i] - overhead) * samplePeriod);
+            out << " }\n}\n";
+        }
+
+    private:
+        uint64_t calls;
+        double overhead;
+
+        template<class F>
+        static double timed(F f) {
+            const std::chrono::steady_clock::time_point start =
+                std::chrono::steady_clock::now();
+            volatile int result = f();
+            (void)result;
+            return std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+        }
+
+        template<int MaxB1>
+        void sample(const searchState<MaxB1> &s) {
+            ++samples;
+            seconds[0] += timed([&]() { return s.components(); });
+            seconds[1] += timed([&]() { return s.missingCrossings(); });
+            seconds[2] += timed([&]() { return s.lexicoGood(); });
+            seconds[3] += timed([&]() { return s.reidemeister(); });
+            seconds[4] += timed([&]() { return lastLetterTooHigh(s); });
+            overhead += timed([]() { return 0; });
+        }
+};
+
+/* A bounded table of the summaries (see searchState::summary()) of braids
+ * below which the search found no admissible braid, so that it can skip
+ * the subtrees of other braids with the same summary. It is only correct
+ * without searchRules, which look at whole braids. The summaries go to
+ * buckets of four entries, in each of which the clock algorithm picks the
+ * entry to replace: a hand goes round the entries, sparing (and clearing
+ * the mark of) those found since it last passed them.
+ */
+class deadPrefixes {
+    public:
+        uint64_t lookups, hits, added;
+
+        // A table of at most the given number of bytes.
+        deadPrefixes(size_t bytes)
+            : lookups(0), hits(0), added(0),
+            buckets(std::max(bytes / ((sizeof(entry) + 1) * ways + 1),
+                        (size_t)1)),
+            entries(buckets * ways), hands(buckets, 0),
+            marks(buckets * ways, 0) {}
+
+        bool contains(const byteHash &h) {
+            ++lookups;
+            const size_t b = h.low % buckets;
+            for (size_t i = b * ways; i < (b + 1) * ways; ++i)
+                if ((entries[i].low == h.low) && (entries[i].high == h.high)) {
+                    marks[i] = 1;
+                    ++hits;
+                    return true;
+                }
+            return false;
+        }
+
+        void add(const byteHash &h) {
+            ++added;
+            const size_t b = h.low % buckets;
+            while (marks[b * ways + hands[b]]) {
+                marks[b * ways + hands[b]] = 0;
+                hands[b] = (hands[b] + 1) % ways;
+            }
+            entries[b * ways + hands[b]].low = h.low;
+            entries[b * ways + hands[b]].high = h.high;
+            hands[b] = (hands[b] + 1) % ways;
+        }
+
+    private:
+        static const size_t ways = 4;
+        class entry {
+            public:
+                uint64_t low, high;
+                entry() : low(0), high(0) {}
+        };
+        size_t buckets;
+        std::vector<entry> entries;
+        std::vector<uint8_t> hands;
+        std::vector<uint8_t> marks;
+};
+
+/* The last level of the search below a completable braid with b1() ==
+ * maxB1 - 1, as in searchTree(): the children with a last letter up to the
+ * max are evaluated at once by searchState::leafMask(), and those that are
+ * admissible handed to leaf() (and counted in found). The braid is left at
+ * its last child, the one with a new generator, for the search to go on
+ * below.
+ */
+template<int MaxB1, class Leaf>
+void leaves(searchState<MaxB1> &s, Leaf &leaf, uint64_t &found) {
+    const uint64_t mask = s.leafMask();
+    const int m = s.maxOfFirst(s.braid.size());
+    if (debug)
+        for (int x = (s.braid.back() == 1) ? 1 : (s.braid.back() - 1);
+                x <= m; ++x) {
+            s.push(x);
+            if ((completable(s) == 15) != ((mask >> x) & 1))
+                throw;
+            s.pop();
+        }
+    for (uint64_t left = mask; left; left &= left - 1) {
+        s.push(lowestBit(left));
+        if ((!s.rules.symmetry || s.reverseGood()) &&
+                rulesGood(s.rules, s.braid)) {
+            leaf(s.braid);
+            ++found;
+        }
+        s.pop();
+    }
+    s.push(m + 1);
+}
+
+/* Depth-first search through the part of the search tree below the current
+ * braid, never changing its first base letters. Every admissible braid is
+ * handed to leaf(). If splitSize is non-zero, the search does not descend
+ * below completable braids of that length, but hands them to prefix()
+ * instead, so that their subtrees can be searched independently. If stats
+ * is not null, the braids visited are counted there. If dead is not null,
+ * the search does not descend below braids whose summaries are there, and
+ * adds the summaries of those below which it found nothing. Unless stats
+ * is counting every braid, the last level of the tree is searched a
+ * sibling group at a time by leaves().
+ */
+template<int MaxB1, class Leaf, class Prefix>
+void searchTree(searchState<MaxB1> &s, size_t base, size_t splitSize,
+        Leaf &leaf, Prefix &prefix, searchStats *stats = 0,
+        deadPrefixes *dead = 0) {
+    // For dead: the summaries of the braids the search descended below,
+    // whether it did so at each length, and the number of braids found
+    // (or cut off) before.
+    byteHash summaries[2 * MaxB1 + 2];
+    bool below[2 * MaxB1 + 2] = { false };
+    uint64_t found = 0;
+    uint64_t foundBefore[2 * MaxB1 + 2];
+    // Stats count the children one by one.
+    const bool batch = !stats;
+    while (s.braid.size() > base) {
+        if (stats)
+            stats->visit(s);
+        if (debug) {
+            std::cerr << "Working on \"";
+            printBraid(s.braid, std::cerr, false);
+            std::cerr << "\". ";
+        }
+        if (lastLetterTooHigh(s)) {
+            if (stats)
+                ++stats->tooHigh[s.braid.size()];
+            if (debug)
+                std::cerr << "Last letter too high, popping back.\n";
+            s.pop();
+            const size_t n = s.braid.size();
+            if (dead && below[n]) {
+                below[n] = false;
+                if (foundBefore[n] == found)
+                    dead->add(summaries[n]);
+            }
+            s.increase();
+            continue;
+        }
+        if (debug)
+            std::cerr << "Last letter good. ";
+        int c;
+        if ((c = completable(s)) != 15) {
+            if (stats)
+                stats->notCompletable(s.braid.size(), c);
+            if (debug)
+                std::cerr << "Not completable (" << c << "), increasing.\n";
+            s.increase();
+            continue;
+        }
+        if (s.rules.symmetry && !s.reverseGood()) {
+            if (stats)
+                ++stats->pruned[s.braid.size()];
+            if (debug)
+                std::cerr << "Reverse is smaller, increasing.\n";
+            s.increase();
+            continue;
+        }
+        if (debug)
+            std::cerr << "Is completable. ";
+        if (s.b1() < MaxB1) {
+            if (splitSize && (s.braid.size() == splitSize)) {
+                if (stats)
+                    ++stats->split[s.braid.size()];
+                if (debug)
+                    std::cerr << "Splitting off subtree.\n";
+                prefix(s.braid);
+                ++found;
+                s.increase();
+                continue;
+            }
+            // Summaries of shorter braids contain most of the braid, so
+            // the search hardly ever meets them twice.
+            if (dead && (2 * s.braid.size() >= 2 * MaxB1 + 1)) {
+                const size_t n = s.braid.size();
+                uint8_t key[searchState<MaxB1>::summaryBytes];
+                summaries[n] = byteHash(key, s.summary(key));
+                if (dead->contains(summaries[n])) {
+                    if (debug)
+                        std::cerr << "Nothing below the same summary.\n";
+                    s.increase();
+                    continue;
+                }
+                below[n] = true;
+                foundBefore[n] = found;
+            }
+            if (batch && (s.b1() == MaxB1 - 1)) {
+                leaves(s, leaf, found);
+                continue;
+            }
+            if (debug)
+                std::cerr << "Too short, appending.\n";
+            appendLetter(s);
+            continue;
+        }
+        if (!rulesGood(s.rules, s.braid)) {
+            if (stats)
+                ++stats->pruned[s.braid.size()];
+            if (debug)
+                std::cerr << "A symmetric or commuted braid is smaller.\n";
+            s.increase();
+            continue;
+        }
+        // Admissible braids are knots, as completable() allows for at most
+        // 1 + maxB1 - b1() components.
+        if (debug && (s.components() != 1))
+            throw;
+        if (stats)
+            ++stats->admissible[s.braid.size()];
+        if (debug)
+            std::cerr << "Is good!\n";
+        leaf(s.braid);
+        ++found;
+        s.increase();
+    }
+}
+
+/* How the braids are written: either as text lines "word: n counter dt..."
+ * (where n is the length of the word, and the DT-code dt may be left out),
+ * or in the binary format, which starts with the header
+ *    "LBRD", version, flags, bits per letter, genus
+ * of one byte each (flag 1 is set if the DT-codes are included),
+ * followed by one record per braid: its length n as a varint, its
+ * letters, two to a byte (lower nibble first) if there are 4 bits per
+ * letter, and if flag 1 is set, the n entries of its DT-code as zig-zag
+ * encoded varints. The counter is the number of the record. If flag 2 is
+ * set (see compressedOutput), the records are front-coded: after n comes,
+ * as another varint, the number of letters shared with the braid of the
+ * record before, and only the remaining letters follow.
+ */
+class outputFormat {
+    public:
+        bool binary;
+        bool withDT;
+        int letterBits;
+
+        outputFormat() : binary(false), withDT(true), letterBits(8) {}
+};
+
+const char binaryMagic[] = "LBRD";
+const int binaryVersion = 1;
+const int binaryWithDT = 1;
+const int binaryFrontCoded = 2;
+
+// Writes x in groups of seven bits, least significant first, with the
+// highest bit of a byte set if more bytes follow.
+inline void putVarint(unsigned long x, outputBuffer &out) {
+    while (x >= 0x80) {
+        out.put((char)(x | 0x80));
+        x >>= 7;
+    }
+    out.put((char)x);
+}
+
+// Returns false at the end of the input.
+inline bool getVarint(inputBuffer &in, unsigned long &x) {
+    x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        const int c = in.get();
+        if (c < 0)
+            return false;
+        x |= (unsigned long)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline void printBinaryHeader(int g, const outputFormat &format,
+        outputBuffer &out) {
+    out.put(binaryMagic, 4);
+    out.put((char)binaryVersion);
+    out.put((char)format.withDT);
+    out.put((char)format.letterBits);
+    out.put((char)g);
+}
+
+inline void printBinary(const braidWord &braid, const outputFormat &format,
+        dtScratch &scratch, outputBuffer &out) {
+    putVarint(braid.size(), out);
+    if (format.letterBits == 4) {
+        for (size_t i = 0; i < braid.size(); i += 2)
+            out.put((char)(braid.at(i) |
+                        ((i + 1 < braid.size()) ? braid.at(i + 1) << 4 : 0)));
+    } else
+        out.put((const char *)braid.data(), braid.size());
+    if (format.withDT && computeDT(braid, scratch))
+        for (size_t i = 0; i < braid.size(); ++i)
+            putVarint(((unsigned)scratch.dt[i] << 1) ^
+                    (unsigned)(scratch.dt[i] >> 31), out);
+}
+
+// Prints a braid in the given format. In the text format, this means with
+// its counter and DT-code, or with a mark instead of the counter if
+// counter is zero. The DT-code is only computed if it is printed.
+inline void printResult(const braidWord &braid, uint64_t counter,
+        dtScratch &scratch, outputBuffer &out, const outputFormat &format) {
+    if (format.binary) {
+        printBinary(braid, format, scratch, out);
+        return;
+    }
+    printBraid(braid, out);
+    if (!format.withDT)
+        printDT(0, braid.size(), counter, out);
+    else if (!printDT(braid, counter, scratch, out) && debug)
+        throw;
+}
+
+/* Cheap knot invariants for removing doubles: the Alexander polynomial
+ * Delta(t), from the reduced Burau matrix B(t) of the braid on n strands,
+ *    det(I - B(t)) = (1 + t + ... + t^(n-1)) Delta(t),
+ * up to a unit +-t^k. It is evaluated modulo the prime 2^61 - 1 at t0 and
+ * at 1/t0, for t0 = 2 and t0 = 3. Since Delta(t) = Delta(1/t) for the
+ * right choice of unit, the product of the two values is Delta(t0)^2 for
+ * every choice of unit.
+ */
+const uint64_t fingerprintPrime = ((uint64_t)1 << 61) - 1;
+
+inline uint64_t mulMod(uint64_t a, uint64_t b) {
+    const unsigned __int128 x = (unsigned __int128)a * b;
+    const uint64_t r = (uint64_t)(x & fingerprintPrime) + (uint64_t)(x >> 61);
+    return (r >= fingerprintPrime) ? r - fingerprintPrime : r;
+}
+
+inline uint64_t subMod(uint64_t a, uint64_t b) {
+    return (a >= b) ? a - b : a + fingerprintPrime - b;
+}
+
+inline uint64_t powMod(uint64_t a, uint64_t e) {
+    uint64_t result = 1;
+    for (; e; e >>= 1, a = mulMod(a, a))
+        if (e & 1)
+            result = mulMod(result, a);
+    return result;
+}
+
+// det(I - B(t)) / (1 + t + ... + t^(n-1)) modulo fingerprintPrime.
+inline uint64_t alexanderValue(const braidWord &b, uint64_t t) {
+    const int d = max(b);
+    // The columns of B(t), starting from the identity. The letter i only
+    // changes the column i - 1, to t (B[i-2] - B[i-1]) + B[i].
+    uint64_t m[braidWord::capacity][braidWord::capacity];
+    for (int i = 0; i < d; ++i)
+        for (int j = 0; j < d; ++j)
+            m[i][j] = (i == j);
+    for (braidWord::const_iterator l = b.begin(); l != b.end(); ++l) {
+        const int i = *l - 1;
+        for (int r = 0; r < d; ++r) {
+            uint64_t x = subMod((i > 0) ? m[i - 1][r] : 0, m[i][r]);
+            x = mulMod(x, t);
+            if (i + 1 < d)
+                x = (x + m[i + 1][r]) % fingerprintPrime;
+            m[i][r] = x;
+        }
+    }
+    // Gaussian elimination of the columns of I - B(t). To avoid a division
+    // per column, a column j is replaced by p * column j - q * column k,
+    // which multiplies the determinant by p; these factors are collected in
+    // scale, and divided out at the end together with 1 + ... + t^(n-1).
+    for (int i = 0; i < d; ++i)
+        for (int j = 0; j < d; ++j)
+            m[i][j] = subMod(i == j, m[i][j]);
+    uint64_t det = 1, scale = 1;
+    for (int k = 0; k < d; ++k) {
+        int pivot = k;
+        while ((pivot < d) && (m[pivot][k] == 0))
+            ++pivot;
+        if (pivot == d)
+            return 0;
+        if (pivot != k) {
+            for (int r = 0; r < d; ++r)
+                std::swap(m[k][r], m[pivot][r]);
+            det = subMod(0, det);
+        }
+        const uint64_t p = m[k][k];
+        det = mulMod(det, p);
+        for (int j = k + 1; j < d; ++j) {
+            const uint64_t q = m[j][k];
+            if (q == 0)
+                continue;
+            scale = mulMod(scale, p);
+            for (int r = k; r < d; ++r)
+                m[j][r] = subMod(mulMod(p, m[j][r]), mulMod(q, m[k][r]));
+        }
+    }
+    uint64_t sum = 0, power = 1;
+    for (int i = 0; i <= d; ++i, power = mulMod(power, t))
+        sum = (sum + power) % fingerprintPrime;
+    return mulMod(det, powMod(mulMod(scale, sum), fingerprintPrime - 2));
+}
+
+class knotFingerprint {
+    public:
+        uint64_t values[2];
+
+        knotFingerprint(const braidWord &b) {
+            static const uint64_t points[2] = { 2, 3 };
+            for (int i = 0; i < 2; ++i)
+                values[i] = mulMod(alexanderValue(b, points[i]),
+                        alexanderValue(b, powMod(points[i],
+                                fingerprintPrime - 2)));
+        }
+
+        bool operator==(const knotFingerprint &other) const {
+            return (values[0] == other.values[0]) &&
+                (values[1] == other.values[1]);
+        }
+};
+
+class fingerprintHash {
+    public:
+        size_t operator()(const knotFingerprint &f) const {
+            return f.values[0] ^ (f.values[1] * 0x9e3779b97f4a7c15ull);
+        }
+};
+
+/* Puts the braids into buckets by their fingerprints, keeping the first
+ * braid of every bucket in the order of the search as its representative.
+ * The position of a braid in that order is given as the number of its work
+ * item and its number within that item, which also works for the parallel
+ * search, where add() is called from all threads.
+ */
+class knotBuckets {
+    public:
+        typedef std::pair<size_t, size_t> position;
+
+        void add(const braidWord &b, const position &where) {
+            const knotFingerprint f(b);
+            std::lock_guard<std::mutex> lock(m);
+            std::pair<bucketMap::iterator, bool> i =
+                buckets.insert(std::make_pair(f, bucket()));
+            bucket &k = i.first->second;
+            if (i.second || (where < k.first)) {
+                k.first = where;
+                k.representative = b;
+            }
+            ++k.size;
+        }
+
+        /* Prints the representatives in the order of the search, numbered
+         * consecutively. In the text format, a bucket of more than one
+         * braid is marked by " # k" at the end of the line, since its k
+         * braids may still be different knots with the same Alexander
+         * polynomial.
+         */
+        void print(const outputFormat &format, outputBuffer &out) {
+            std::vector<const bucket *> sorted;
+            for (bucketMap::const_iterator i = buckets.begin();
+                    i != buckets.end(); ++i)
+                sorted.push_back(&i->second);
+            std::sort(sorted.begin(), sorted.end(),
+                    [](const bucket *x, const bucket *y) {
+                        return x->first < y->first;
+                    });
+            dtScratch scratch;
+            uint64_t counter = 0;
+            for (std::vector<const bucket *>::const_iterator i =
+                    sorted.begin(); i != sorted.end(); ++i) {
+                printResult((*i)->representative, ++counter, scratch, out,
+                        format);
+                if (format.binary || ((*i)->size == 1))
+                    continue;
+                out.unput();
+                out.put(" # ");
+                out.putUnsigned((*i)->size);
+                out.put('\n');
+            }
+            std::cerr << buckets.size() << " buckets.\n";
+        }
+
+    private:
+        class bucket {
+            public:
+                position first;
+                braidWord representative;
+                uint64_t size;
+
+                bucket() : size(0) {}
+        };
+        typedef std::unordered_map<knotFingerprint, bucket, fingerprintHash>
+            bucketMap;
+
+        std::mutex m;
+        bucketMap buckets;
+};
+
+/* An order-independent digest of a list of braids for --digest: the number
+ * of braids, and the sum modulo 2^128 of a 128-bit hash of each of them.
+ * The digests of the shards of a search thus add up to the digest of the
+ * whole search. The hash only depends on the letters, so that it is the
+ * same on every machine.
+ */
+class braidDigest {
+    public:
+        uint64_t count;
+        uint64_t low, high;
+
+        braidDigest() : count(0), low(0), high(0) {}
+        braidDigest(uint64_t count, uint64_t high, uint64_t low)
+            : count(count), low(low), high(high) {}
+
+        void add(const braidWord &b) {
+            uint64_t h[2] = { 0x6c62272e07bb0142ull, 0x9e3779b97f4a7c15ull };
+            for (int j = 0; j < 2; ++j) {
+                for (braidWord::const_iterator i = b.begin(); i != b.end();
+                        ++i)
+                    h[j] = mix64(h[j] ^ *i);
+                h[j] = mix64(h[j] ^ b.size());
+            }
+            add(braidDigest(1, h[1], h[0]));
+        }
+
+        void add(const braidDigest &other) {
+            count += other.count;
+            low += other.low;
+            high += other.high + (low < other.low);
+        }
+
+        bool operator==(const braidDigest &other) const {
+            return (count == other.count) && (low == other.low) &&
+                (high == other.high);
+        }
+
+        void print(std::ostream &out) const {
+            char hex[40];
+            snprintf(hex, sizeof(hex), "%016llx%016llx",
+                    (unsigned long long)high, (unsigned long long)low);
+            out << count << " " << hex;
+        }
+};
+
+// The digests of the complete lists of genus 1 to 8 (at their index).
+const braidDigest referenceDigests[] = {
+    braidDigest(),
+    braidDigest(1, 0x5c3530e2880fd4f8ull, 0xfa761427ff25a71eull),
+    braidDigest(1, 0x0dc9acb174009634ull, 0x9ade11569136cd59ull),
+    braidDigest(22, 0xcf0315d641217764ull, 0xf9a5d122fbf944feull),
+    braidDigest(366, 0xd34becd25817a637ull, 0x999225195d53d6a3ull),
+    braidDigest(5726, 0x32d3b1c15c23e437ull, 0x7929f726e4f7ad89ull),
+    braidDigest(88126, 0x8306772ddbcba9feull, 0x7d27fae5b86a6496ull),
+    braidDigest(1351441, 0x75eba4bf6023a03bull, 0x11f11b668d3cdb65ull),
+    braidDigest(20739996, 0x25a5dff702197561ull, 0x67bf25fb7aa82124ull)
+};
+
+/* Converts the binary format read from fd back to the text format on
+ * stdout, recomputing the DT-codes if they are not included (flag 1). If
+ * flag 2 is set, the records are front-coded, and each braid starts with
+ * the given number of letters of the one before. Returns false if the
+ * input is not in the binary format.
+ */
+inline bool decodeBinary(int fd) {
+    inputBuffer in(fd);
+    char header[8];
+    for (int i = 0; i < 8; ++i) {
+        const int c = in.get();
+        if (c < 0)
+            return false;
+        header[i] = c;
+    }
+    const int letterBits = header[6];
+    if (memcmp(header, binaryMagic, 4) || (header[4] != binaryVersion) ||
+            (header[5] & ~(binaryWithDT | binaryFrontCoded)) ||
+            ((letterBits != 4) && (letterBits != 8)))
+        return false;
+    const bool withDT = header[5] & binaryWithDT;
+    const bool frontCoded = header[5] & binaryFrontCoded;
+    outputBuffer out(1);
+    dtScratch scratch;
+    braidWord braid;
+    unsigned long n;
+    for (uint64_t counter = 1; getVarint(in, n); ++counter) {
+        unsigned long shared = 0;
+        if ((n == 0) || (n > braidWord::capacity) ||
+                (frontCoded && (!getVarint(in, shared) ||
+                                (shared > std::min(n, braid.size())))))
+            return false;
+        while (braid.size() > shared)
+            braid.pop_back();
+        for (size_t i = shared; i < n; ) {
+            const int c = in.get();
+            if (c < 0)
+                return false;
+            braid.push_back((letterBits == 4) ? (c & 0xf) : c);
+            if ((letterBits == 4) && (++i < n))
+                braid.push_back(c >> 4);
+            ++i;
+        }
+        printBraid(braid, out);
+        if (!withDT) {
+            if (!printDT(braid, counter, scratch, out))
+                return false;
+            continue;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            unsigned long z;
+            if (!getVarint(in, z))
+                return false;
+            scratch.dt[i] = (int)(z >> 1) ^ -(int)(z & 1);
+        }
+        printDT(scratch.dt, n, counter, out);
+    }
+    return true;
+}
+
+#ifdef LB_ZSTD
+#include<zstd.h>
+
+/* Compressed output, for lb built with -DLB_ZSTD (and linked with -lzstd).
+ * The output is cut into frames of frameRecords records (or lines, in the
+ * text format), which are compressed as independent zstd frames, so that
+ *    zstd -dc FILE
+ * gives the output back. Binary records are front-coded before, starting
+ * afresh in every frame, and the header says so. The header is only at
+ * the start of the first frame, so that the frames still concatenate to
+ * one output: a reader can start at any frame of the text format, but a
+ * later frame of the binary format needs the 8 bytes of the header put
+ * in front of it. The frame index comes last, as a skippable frame which
+ * zstd ignores: for every frame, its offset in the file and the counter of
+ * its first record, then the number of frames, all as little-endian 64-bit
+ * numbers, and "LBIX".
+ */
+class compressedOutput : public outputSink {
+    public:
+        static const size_t frameRecords = 1 << 16;
+
+        // Writes the frames to next, or to stdout if it is null.
+        compressedOutput(const outputFormat &format, int level,
+                outputSink *next)
+            : format(format), level(level), file(1, next),
+            context(ZSTD_createCCtx()), header(format.binary ? 8 : 0),
+            offset(0), records(0), inFrame(0) {}
+
+        ~compressedOutput() {
+            ZSTD_freeCCtx(context);
+        }
+
+        void write(const char *data, size_t n) override {
+            pending.insert(pending.end(), data, data + n);
+            size_t done = 0;
+            for (; header && (done < pending.size()); ++done, --header)
+                frame.put((char)((header == 3) ?
+                            (pending[done] | binaryFrontCoded) :
+                            pending[done]));
+            for (size_t end; (end = recordEnd(done)) != 0; done = end) {
+                if (format.binary)
+                    frontCode(done, end);
+                else
+                    frame.put(&pending[done], end - done);
+                ++records;
+                if (++inFrame == frameRecords)
+                    finishFrame();
+            }
+            pending.erase(pending.begin(), pending.begin() + done);
+        }
+
+        // Writes the last frame and the index.
+        void close() {
+            if (frame.size())
+                finishFrame();
+            std::string index;
+            for (std::vector<uint64_t>::const_iterator i = frames.begin();
+                    i != frames.end(); ++i)
+                putLittleEndian(index, *i, 8);
+            putLittleEndian(index, frames.size() / 2, 8);
+            index += "LBIX";
+            std::string skippable;
+            putLittleEndian(skippable, 0x184d2a50, 4);
+            putLittleEndian(skippable, index.size(), 4);
+            file.put(skippable.data(), skippable.size());
+            file.put(index.data(), index.size());
+            file.flush();
+        }
+
+    private:
+        outputFormat format;
+        int level;
+        outputBuffer file;
+        ZSTD_CCtx *context;
+        // The bytes of the binary header still to come.
+        size_t header;
+        std::vector<char> pending;
+        outputBuffer frame;
+        braidWord last;
+        std::vector<char> compressed;
+        // The offset and first counter of every frame written.
+        std::vector<uint64_t> frames;
+        uint64_t offset, records;
+        size_t inFrame;
+
+        // Reads a varint from pending at at, returns false if it is not
+        // complete yet.
+        bool getVarint(size_t &at, unsigned long &x) const {
+            x = 0;
+            for (int shift = 0; at < pending.size(); shift += 7) {
+                const unsigned char c = pending[at++];
+                x |= (unsigned long)(c & 0x7f) << shift;
+                if (!(c & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+        // The end of the record starting at pending[from], or 0 if it is
+        // not complete yet.
+        size_t recordEnd(size_t from) const {
+            if (!format.binary) {
+                const char *end = (const char *)memchr(pending.data() + from,
+                        '\n', pending.size() - from);
+                return end ? (end - pending.data() + 1) : 0;
+            }
+            size_t at = from;
+            unsigned long n, entry;
+            if (!getVarint(at, n))
+                return 0;
+            at += (format.letterBits == 4) ? ((n + 1) / 2) : n;
+            if (at > pending.size())
+                return 0;
+            for (size_t i = 0; format.withDT && (i < n); ++i)
+                if (!getVarint(at, entry))
+                    return 0;
+            return at;
+        }
+
+        // Appends the record from pending[from] to end to the frame,
+        // front-coded.
+        void frontCode(size_t from, size_t end) {
+            size_t at = from;
+            unsigned long n;
+            getVarint(at, n);
+            braidWord braid;
+            for (size_t i = 0; i < n; ++i) {
+                const unsigned char c = pending[at + ((format.letterBits == 4)
+                        ? (i / 2) : i)];
+                braid.push_back((format.letterBits == 4) ?
+                        ((i & 1) ? (c >> 4) : (c & 0xf)) : c);
+            }
+            at += (format.letterBits == 4) ? ((n + 1) / 2) : n;
+            size_t shared = 0;
+            while ((shared < std::min(n, last.size())) &&
+                    (braid.at(shared) == last.at(shared)))
+                ++shared;
+            putVarint(n, frame);
+            putVarint(shared, frame);
+            if (format.letterBits == 4) {
+                for (size_t i = shared; i < n; i += 2)
+                    frame.put((char)(braid.at(i) |
+                                ((i + 1 < n) ? braid.at(i + 1) << 4 : 0)));
+            } else
+                frame.put((const char *)braid.data() + shared, n - shared);
+            // The DT-code, if any, stays as it is.
+            if (end > at)
+                frame.put(&pending[at], end - at);
+            last = braid;
+        }
+
+        void finishFrame() {
+            compressed.resize(ZSTD_compressBound(frame.size()));
+            const size_t size = ZSTD_compressCCtx(context, compressed.data(),
+                    compressed.size(), frame.data(), frame.size(), level);
+            if (ZSTD_isError(size)) {
+                std::cerr << "Compressing the output failed: "
+                    << ZSTD_getErrorName(size) << "\n";
+                exit(1);
+            }
+            frames.push_back(offset);
+            frames.push_back(records - inFrame + 1);
+            file.put(compressed.data(), size);
+            offset += size;
+            frame.clear();
+            last = braidWord();
+            inFrame = 0;
+        }
+
+        static void putLittleEndian(std::string &s, uint64_t x, int bytes) {
+            for (int i = 0; i < bytes; ++i)
+                s += (char)(x >> (8 * i));
+        }
+};
+#endif
+
+// Reads a braid word such as "aabab", returns false if it
+// is not a braid word.
+inline bool parseBraid(const char *word, braidWord &braid) {
+    braid = braidWord();
+    for (; *word; ++word) {
+        if ((*word < 'a') || (*word > 'z') ||
+                (braid.size() == braidWord::capacity))
+            return false;
+        braid.push_back(*word - 96);
+    }
+    return !braid.empty();
+}
+
+/* Checkpoints of a long run: every interval seconds, the output is flushed
+ * and synced, and then the last braid written (or the last subtree
+ * finished, in the parallel search), the counter and the size of the
+ * output so far are written to a small file, which is synced and renamed
+ * into place. A run resumed from it truncates the output to that size and
+ * continues the search right after that braid. This needs the output to
+ * be appended to the same regular file, as in
+ *    lb --resume FILE g >> output
+ * and the same options, which are stored in the checkpoint (except for the
+ * number of threads; the search is cut at the same length as before).
+ */
+class checkpoint {
+    public:
+        std::string file;
+        std::string options;
+        double interval;
+        bool resumed;
+        bool serial;
+        size_t splitSize;
+        braidWord braid;
+        uint64_t counter;
+        off_t offset;
+
+        checkpoint() : interval(60), resumed(false), serial(true),
+            splitSize(0), counter(0), offset(0),
+            last(std::chrono::steady_clock::now()) {}
+
+        bool due() const {
+            return std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - last).count() >=
+                interval;
+        }
+
+        void save(const braidWord &b, uint64_t c, outputBuffer &out) {
+            out.flush();
+            if (fsync(1) && (errno != EINVAL))
+                fail("sync the output");
+            braid = b;
+            counter = c;
+            offset = lseek(1, 0, SEEK_CUR);
+            std::string text = "lb checkpoint 1\noptions" + options +
+                "\nsearch " + (serial ? "serial 0" : "items") +
+                (serial ? "" : " " + std::to_string(splitSize)) + "\nbraid ";
+            for (braidWord::const_iterator i = b.begin(); i != b.end(); ++i)
+                text += (char)(*i + 96);
+            text += "\ncounter " + std::to_string(counter) + "\noffset " +
+                std::to_string(offset) + "\n";
+            const std::string temporary = file + ".tmp";
+            const int fd = open(temporary.c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if ((fd < 0) ||
+                    (write(fd, text.data(), text.size()) !=
+                     (ssize_t)text.size()) ||
+                    fsync(fd) || close(fd) ||
+                    rename(temporary.c_str(), file.c_str()))
+                fail("write the checkpoint");
+            last = std::chrono::steady_clock::now();
+        }
+
+        // Reads the checkpoint file, returns false if it is not valid.
+        bool load() {
+            std::ifstream in(file.c_str());
+            std::string line, word, mode;
+            if (!std::getline(in, line) || (line != "lb checkpoint 1") ||
+                    !std::getline(in, line) || (line.compare(0, 7, "options")))
+                return false;
+            const std::string saved = line.substr(7);
+            if (!(in >> word >> mode >> splitSize) || (word != "search") ||
+                    ((mode != "serial") && (mode != "items")) ||
+                    !(in >> word) || (word != "braid") || !(in >> word) ||
+                    !parseBraid(word.c_str(), braid) ||
+                    !(in >> word >> counter) || (word != "counter") ||
+                    !(in >> word >> offset) || (word != "offset"))
+                return false;
+            if (saved != options) {
+                std::cerr << "The checkpoint was written with the options \""
+                    << saved.substr(1) << "\".\n";
+                return false;
+            }
+            serial = (mode == "serial");
+            resumed = true;
+            return true;
+        }
+
+        // Called at the end of the run.
+        void finish(outputBuffer &out) {
+            out.flush();
+            unlink(file.c_str());
+        }
+
+    private:
+        std::chrono::steady_clock::time_point last;
+
+        void fail(const char *what) {
+            std::cerr << "Could not " << what << " for the checkpoint.\n";
+            exit(1);
+        }
+};
+
+// If buckets or digest is not null, the braids go there instead of to the
+// output. If ckpt is not null, checkpoints are written, and the search
+// continues from a checkpoint that was resumed. If stats is not null, the
+// search tree is counted there. If deadBytes is not zero, the search skips
+// subtrees with a table of deadPrefixes of that size. If file is not null,
+// the output goes there instead of to stdout.
+template<int MaxB1>
+void listBraids(const searchRules &rules, const outputFormat &format,
+        knotBuckets *buckets, braidDigest *digest, checkpoint *ckpt,
+        searchStats *stats, size_t deadBytes = 0, outputSink *file = 0) {
+    uint64_t counter = 0;
+    searchState<MaxB1> s({ 1, 1 }, rules);
+    if (ckpt && ckpt->resumed) {
+        s = searchState<MaxB1>(ckpt->braid, rules);
+        s.increase();
+        counter = ckpt->counter;
+    }
+    dtScratch scratch;
+    outputBuffer out(1, file);
+    if (format.binary && !digest && !(ckpt && ckpt->resumed))
+        printBinaryHeader(MaxB1 / 2, format, out);
+    auto leaf = [&](const braidWord &b) {
+        if (buckets)
+            buckets->add(b, knotBuckets::position(0, ++counter));
+        else if (digest)
+            digest->add(b);
+        else
+            printResult(b, ++counter, scratch, out, format);
+        if (ckpt && ((counter % 256) == 0) && ckpt->due())
+            ckpt->save(b, counter, out);
+    };
+    auto prefix = [](const braidWord &) {};
+    deadPrefixes dead(deadBytes);
+    searchTree(s, 1, 0, leaf, prefix, stats, deadBytes ? &dead : 0);
+    if (buckets)
+        buckets->print(format, out);
+    if (ckpt)
+        ckpt->finish(out);
+}
+
+/* Lists the braids of all genera from lowest to MaxB1 / 2 in one search.
+ * As completable() only gets weaker for a bigger maxB1, and b1() grows by
+ * at most one per letter, the search tree of a genus is part of the one of
+ * every higher genus. So the search of the highest genus visits all the
+ * braids the other searches would, in the same order, and only needs to
+ * know for which genera they are admissible, or would be searched below.
+ * The braids of genus g go to out[g], numbered as in a search of genus g.
+ */
+template<int MaxB1>
+void listGenera(const searchRules &rules, int lowest,
+        const outputFormat &format, outputBuffer *out) {
+    const int highest = MaxB1 / 2;
+    // Bit g of alive[n] is set if the search of genus g goes on below the
+    // first n letters of the braid.
+    uint32_t alive[2 * MaxB1 + 2];
+    alive[1] = (((uint32_t)2 << highest) - 1) & ~(((uint32_t)1 << lowest) - 1);
+    uint64_t counter[highest + 1];
+    std::fill(counter, counter + highest + 1, 0);
+    dtScratch scratch;
+    for (int g = lowest; g <= highest; ++g)
+        if (format.binary)
+            printBinaryHeader(g, format, out[g]);
+    searchState<MaxB1> s({ 1, 1 }, rules);
+    while (s.braid.size() > 1) {
+        if (lastLetterTooHigh(s)) {
+            s.pop();
+            s.increase();
+            continue;
+        }
+        if ((completable(s) != 15) || (rules.symmetry && !s.reverseGood())) {
+            s.increase();
+            continue;
+        }
+        // Only the first two conditions of completable() depend on maxB1.
+        const size_t n = s.braid.size();
+        const int b1 = s.b1();
+        const int components = s.components();
+        const int missing = s.missingCrossings();
+        alive[n] = 0;
+        for (int g = lowest; g <= highest; ++g) {
+            if (!((alive[n - 1] >> g) & 1) ||
+                    (components - (2 * g - b1) > 1) || (missing > 2 * g - b1))
+                continue;
+            if (debug && (completable(s, 2 * g) != 15))
+                throw;
+            if (b1 < 2 * g)
+                alive[n] |= (uint32_t)1 << g;
+            else if (rulesGood(rules, s.braid))
+                printResult(s.braid, ++counter[g], scratch, out[g], format);
+        }
+        // The highest genus is alive unless the braid is admissible for it.
+        if (alive[n])
+            appendLetter(s);
+        else
+            s.increase();
+    }
+}
+
+// One piece of work for the parallel search, in depth-first order: either a
+// single admissible braid found while splitting the tree, or the subtree
+// below a completable braid.
+class workItem {
+    public:
+        braidWord braid;
+        bool isLeaf;
+        bool done;
+        outputBuffer found;
+        // The number of admissible braids in it, once it is done.
+        uint64_t count;
+};
+
+// Cuts the search tree at braid length splitSize, counting the part of the
+// tree above the cut in stats if it is not null.
+template<int MaxB1>
+std::vector<workItem> splitTree(const searchRules &rules, size_t splitSize,
+        searchStats *stats = 0) {
+    std::vector<workItem> items;
+    searchState<MaxB1> s({ 1, 1 }, rules);
+    auto add = [&](const braidWord &b, bool isLeaf) {
+        items.push_back(workItem());
+        items.back().braid = b;
+        items.back().isLeaf = isLeaf;
+        items.back().done = isLeaf;
+        items.back().count = isLeaf;
+    };
+    auto leaf = [&](const braidWord &b) { add(b, true); };
+    auto prefix = [&](const braidWord &b) { add(b, false); };
+    searchTree(s, 1, splitSize, leaf, prefix, stats);
+    return items;
+}
+
+// Cuts the search tree at the first length giving at least the wanted
+// number of work items.
+template<int MaxB1>
+std::vector<workItem> splitTreeInto(const searchRules &rules, size_t wanted,
+        size_t &splitSize, searchStats *stats = 0) {
+    std::vector<workItem> items;
+    for (splitSize = 3; ; ++splitSize) {
+        if (stats)
+            *stats = searchStats();
+        items = splitTree<MaxB1>(rules, splitSize, stats);
+        if ((items.size() >= wanted) || (splitSize > (size_t)(2 * MaxB1)))
+            return items;
+    }
+}
+
+// The mean of some samples, with the half-width of its 95% confidence
+// interval.
+class sampleMean {
+    public:
+        sampleMean() : n(0), sum(0), squares(0) {}
+
+        void add(double x) {
+            ++n;
+            sum += x;
+            squares += x * x;
+        }
+
+        double mean() const {
+            return n ? (sum / n) : 0;
+        }
+
+        double error() const {
+            if (n < 2)
+                return 0;
+            const double variance = (squares - sum * mean()) / (n - 1);
+            return 1.96 * sqrt(std::max(variance, 0.0) / n);
+        }
+
+    private:
+        long n;
+        double sum, squares;
+};
+
+/* One of Knuth's random probes of the search tree below the braid of s:
+ * walking down from it, each time to a random one of the braids the search
+ * appends letters to, and weighting every braid met on the way with the
+ * product of the numbers of choices above it, gives unbiased estimates of
+ * the number of braids the search visits below it, and of the admissible
+ * braids among them, which are added to visited and admissible. Returns
+ * the number of braids the probe visited itself.
+ */
+template<int MaxB1, class Random>
+long probeTree(searchState<MaxB1> s, Random &random, double &visited,
+        double &admissible) {
+    long probed = 0;
+    double weight = 1;
+    while (true) {
+        // The last letters of the braids to go on with.
+        int inner[MaxB1 + 4];
+        int choices = 0;
+        appendLetter(s);
+        for (;; s.increase()) {
+            ++probed;
+            visited += weight;
+            if (lastLetterTooHigh(s))
+                break;
+            if ((completable(s) != 15) ||
+                    (s.rules.symmetry && !s.reverseGood()))
+                continue;
+            if (s.b1() < MaxB1)
+                inner[choices++] = s.braid.back();
+            else if (rulesGood(s.rules, s.braid))
+                admissible += weight;
+        }
+        s.pop();
+        if (choices == 0)
+            return probed;
+        const int letter = inner[std::uniform_int_distribution<int>(0,
+                choices - 1)(random)];
+        appendLetter(s);
+        while (s.braid.back() != letter)
+            s.increase();
+        weight *= choices;
+    }
+}
+
+/* Estimates the search tree below braid (which the search must append
+ * letters to) with the given number of probes of probeTree(), adding one
+ * sample per probe to visited and admissible. Returns the number of braids
+ * visited by the probes.
+ */
+template<int MaxB1>
+long estimateTree(const searchRules &rules, const braidWord &braid,
+        long probes, uint64_t seed, sampleMean &visited,
+        sampleMean &admissible) {
+    std::mt19937_64 random(seed);
+    const searchState<MaxB1> s(braid, rules);
+    long probed = 0;
+    for (long i = 0; i < probes; ++i) {
+        double v = 0, a = 0;
+        probed += probeTree(s, random, v, a);
+        visited.add(v);
+        admissible.add(a);
+    }
+    return probed;
+}
+
+// Estimates the number of braids the search visits in the subtree below a
+// work item with the given number of probes, the same for every run.
+template<int MaxB1>
+double estimateSize(const searchRules &rules, const workItem &item,
+        long probes = 256) {
+    if (item.isLeaf)
+        return 1;
+    sampleMean visited, admissible;
+    estimateTree<MaxB1>(rules, item.braid, probes, 1, visited, admissible);
+    return visited.mean();
+}
+
+/* The work items of shard number shard out of shards: the items are cut
+ * into shards consecutive runs of about the same estimated size (see
+ * estimateSize()), so that concatenating the outputs of the shards in
+ * order gives the list of the complete search. The estimates are the same
+ * for every run, and so is the cut.
+ */
+template<int MaxB1>
+std::vector<workItem> shardItems(const searchRules &rules,
+        const std::vector<workItem> &items, int shard, int shards) {
+    std::vector<double> before(1, 0);
+    for (std::vector<workItem>::const_iterator i = items.begin();
+            i != items.end(); ++i)
+        before.push_back(before.back() + estimateSize<MaxB1>(rules, *i));
+    // An item goes to the shard its middle falls into.
+    std::vector<workItem> mine;
+    for (size_t i = 0; i < items.size(); ++i)
+        if ((int)((before.at(i) + before.at(i + 1)) / 2 * shards /
+                    before.back()) == shard)
+            mine.push_back(items.at(i));
+    return mine;
+}
+
+/* Searches the subtrees of the work items on the given number of threads.
+ * Idle threads claim the next unsearched subtree in depth-first order, so
+ * that the subtrees finish roughly in order. Each of them prints the
+ * braids of its subtree into a buffer of its own, and the main thread
+ * copies these buffers to the output in exactly the order (and with the
+ * numbering) of the sequential search. A thread only starts on a subtree
+ * less than window work items past the one being copied out, so that at
+ * most about window buffers wait in memory. If buckets is not null, the
+ * braids go there instead. If ckpt is not null, checkpoints are written after
+ * work items, and if it was resumed, the counter continues from it (the
+ * work items already done must have been removed). If digest is not null,
+ * the braids are only added to it. If stats is not null, the subtrees are
+ * counted there. If deadBytes is not zero, the threads share it out for
+ * tables of deadPrefixes of their own. If file is not null, the output
+ * goes there instead of to stdout.
+ */
+template<int MaxB1>
+void searchItems(const searchRules &rules, std::vector<workItem> &items,
+        unsigned threads, const outputFormat &format, knotBuckets *buckets,
+        braidDigest *digest, checkpoint *ckpt, searchStats *stats,
+        size_t deadBytes = 0, outputSink *file = 0) {
+    std::atomic<size_t> next(0);
+    std::mutex m;
+    std::condition_variable finished;
+    // The number of work items copied out, guarded by m, and threads
+    // waiting for it to grow.
+    const size_t window = 4 * threads;
+    size_t copied = 0;
+    std::condition_variable room;
+    auto work = [&]() {
+        auto prefix = [](const braidWord &) {};
+        dtScratch scratch;
+        searchStats counted;
+        braidDigest summed;
+        deadPrefixes dead(deadBytes / threads);
+        for (size_t t; (t = next++) < items.size(); ) {
+            if (items.at(t).isLeaf)
+                continue;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                room.wait(lock, [&]() { return t < copied + window; });
+            }
+            outputBuffer found;
+            size_t local = 0;
+            auto leaf = [&](const braidWord &b) {
+                ++local;
+                if (buckets)
+                    buckets->add(b, knotBuckets::position(t, local));
+                else if (digest)
+                    summed.add(b);
+                else
+                    printResult(b, 0, scratch, found, format);
+            };
+            searchState<MaxB1> s(items.at(t).braid, rules);
+            appendLetter(s);
+            searchTree(s, items.at(t).braid.size(), 0, leaf, prefix,
+                    stats ? &counted : 0, deadBytes ? &dead : 0);
+            std::lock_guard<std::mutex> lock(m);
+            items.at(t).found.swap(found);
+            items.at(t).count = local;
+            items.at(t).done = true;
+            finished.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(m);
+        if (stats)
+            stats->add(counted);
+        if (digest)
+            digest->add(summed);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; ++i)
+        pool.push_back(std::thread(work));
+
+    uint64_t counter = (ckpt && ckpt->resumed) ? ckpt->counter : 0;
+    dtScratch scratch;
+    outputBuffer out(1, file);
+    if (format.binary && !digest && !(ckpt && ckpt->resumed))
+        printBinaryHeader(MaxB1 / 2, format, out);
+    // The leaf items, added to digest once the workers are done with it.
+    braidDigest leaves;
+    for (std::vector<workItem>::iterator i = items.begin(); i != items.end();
+            ++i) {
+        outputBuffer found;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            finished.wait(lock, [&]() { return i->done; });
+            found.swap(i->found);
+            copied = i - items.begin() + 1;
+        }
+        room.notify_all();
+        if (i->isLeaf && buckets)
+            buckets->add(i->braid, knotBuckets::position(i - items.begin(), 0));
+        else if (i->isLeaf && digest)
+            leaves.add(i->braid);
+        else if (i->isLeaf)
+            printResult(i->braid, ++counter, scratch, out, format);
+        else {
+            out.copy(found, counter);
+            // The binary format has no marks for copy() to count.
+            if (format.binary)
+                counter += i->count;
+        }
+        if (ckpt && ckpt->due())
+            ckpt->save(i->braid, counter, out);
+    }
+    for (std::vector<std::thread>::iterator i = pool.begin(); i != pool.end();
+            ++i)
+        i->join();
+    if (digest)
+        digest->add(leaves);
+    if (buckets)
+        buckets->print(format, out);
+    if (ckpt)
+        ckpt->finish(out);
+}
+
+/* The number of braids in every subtree below the cut of the search tree
+ * at one braid length, from a complete search of one genus with some
+ * searchRules, so that the braid with a given number (its rank in the
+ * list) or the number of a given braid can be found by searching only one
+ * subtree. It is written to a file as
+ *    lb index 1
+ *    genus g rules symmetry commutation
+ *    split K
+ * followed by a line "braid count" or "braid leaf" for every work item
+ * (see splitTree()), in order.
+ */
+class braidIndex {
+    public:
+        int genus;
+        searchRules rules;
+        size_t splitSize;
+        std::vector<workItem> items;
+        // The number of braids before each work item.
+        std::vector<uint64_t> before;
+
+        bool save(const std::string &file) const {
+            std::ofstream out(file.c_str());
+            out << "lb index 1\ngenus " << genus << " rules "
+                << rules.symmetry << " " << rules.commutation << "\nsplit "
+                << splitSize << "\n";
+            for (std::vector<workItem>::const_iterator i = items.begin();
+                    i != items.end(); ++i) {
+                printBraid(i->braid, out, false);
+                if (i->isLeaf)
+                    out << " leaf\n";
+                else
+                    out << " " << i->count << "\n";
+            }
+            return (bool)out.flush();
+        }
+
+        // Returns false if the file is not a valid index.
+        bool load(const std::string &file) {
+            std::ifstream in(file.c_str());
+            std::string line, word, count;
+            if (!std::getline(in, line) || (line != "lb index 1") ||
+                    !(in >> word >> genus) || (word != "genus") ||
+                    !(in >> word >> rules.symmetry >> rules.commutation) ||
+                    (word != "rules") || !(in >> word >> splitSize) ||
+                    (word != "split"))
+                return false;
+            items.clear();
+            before.clear();
+            uint64_t total = 0;
+            while (in >> word >> count) {
+                items.push_back(workItem());
+                workItem &item = items.back();
+                item.isLeaf = (count == "leaf");
+                item.count = item.isLeaf ? 1 : strtoull(count.c_str(), 0, 10);
+                if (!parseBraid(word.c_str(), item.braid))
+                    return false;
+                before.push_back(total);
+                total += item.count;
+            }
+            return in.eof();
+        }
+
+        uint64_t size() const {
+            return items.empty() ? 0 : (before.back() + items.back().count);
+        }
+
+        // The work item the braid with the given number (from 1) is in.
+        size_t itemOf(uint64_t number) const {
+            return std::upper_bound(before.begin(), before.end(), number - 1) -
+                before.begin() - 1;
+        }
+};
+
+/* Prints the braids with the numbers from first up to (not including) end
+ * of the list of the index, numbered as in the complete search, but only
+ * searching the subtrees they are in. If file is not null, the output goes
+ * there instead of to stdout.
+ */
+template<int MaxB1>
+void listRange(const braidIndex &index, uint64_t first, uint64_t end,
+        const outputFormat &format, outputSink *file = 0) {
+    dtScratch scratch;
+    outputBuffer out(1, file);
+    if (format.binary)
+        printBinaryHeader(MaxB1 / 2, format, out);
+    auto prefix = [](const braidWord &) {};
+    for (size_t i = index.itemOf(first); (i < index.items.size()) &&
+            (index.before.at(i) + 1 < end); ++i) {
+        const workItem &item = index.items.at(i);
+        uint64_t counter = index.before.at(i);
+        if (item.isLeaf) {
+            printResult(item.braid, ++counter, scratch, out, format);
+            continue;
+        }
+        // The search of the subtree stops at the end of the range.
+        struct rangeEnd {};
+        auto leaf = [&](const braidWord &b) {
+            if (++counter >= end)
+                throw rangeEnd();
+            if (counter >= first)
+                printResult(b, counter, scratch, out, format);
+        };
+        searchState<MaxB1> s(item.braid, index.rules);
+        appendLetter(s);
+        try {
+            searchTree(s, item.braid.size(), 0, leaf, prefix);
+        } catch (rangeEnd) {
+        }
+    }
+}
+
+// The number of the braid in the list of the index, or 0 if it is not in
+// the list.
+template<int MaxB1>
+uint64_t rankBraid(const braidIndex &index, const braidWord &braid) {
+    for (size_t i = 0; i < index.items.size(); ++i) {
+        const workItem &item = index.items.at(i);
+        if (item.isLeaf) {
+            if (item.braid == braid)
+                return index.before.at(i) + 1;
+            continue;
+        }
+        if ((braid.size() <= item.braid.size()) ||
+                !std::equal(item.braid.begin(), item.braid.end(),
+                    braid.begin()))
+            continue;
+        uint64_t counter = index.before.at(i);
+        struct found {};
+        auto leaf = [&](const braidWord &b) {
+            ++counter;
+            if (b == braid)
+                throw found();
+        };
+        auto prefix = [](const braidWord &) {};
+        searchState<MaxB1> s(item.braid, index.rules);
+        appendLetter(s);
+        try {
+            searchTree(s, item.braid.size(), 0, leaf, prefix);
+        } catch (found) {
+            return counter;
+        }
+        return 0;
+    }
+    return 0;
+}
+
+// A batch of consecutive braids of the list, on its way through
+// pipelineBraids(), with the counter of the first one.
+class braidBatch {
+    public:
+        static const size_t capacity = 512;
+        braidWord braids[capacity];
+        size_t size;
+        uint64_t first;
+        outputBuffer found;
+};
+
+/* A ring of batches for pipelineBraids(), through which every batch passes
+ * in three stages: the search fills it, a worker prints it, and the writer
+ * writes it out. Each stage of a ring is run by a single thread, and
+ * passed[k] is the number of batches stage k is done with, so the ring
+ * needs no lock: the batch with the sequence number j may enter stage k
+ * once passed[k - 1] > j, and the search only refills its slot once the
+ * writer is done with it, so that it waits when the output falls behind.
+ * A waiting thread yields for a while, and then sleeps until a stage
+ * passes a batch, so that idle threads do not keep their cores busy.
+ */
+class batchRing {
+    public:
+        static const size_t slots = 8;
+        // The times a waiting thread yields before it sleeps.
+        static const int spins = 256;
+
+        batchRing() : sleepers(0) {
+            for (int k = 0; k < 3; ++k)
+                passed[k] = 0;
+        }
+
+        // Waits until the batch j may enter the stage, and returns it.
+        braidBatch &wait(int stage, size_t j) {
+            for (int i = 0; !ready(stage, j); ++i) {
+                if (i < spins) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                // pass() sees sleepers > 0 or its batch is seen here.
+                std::unique_lock<std::mutex> lock(m);
+                ++sleepers;
+                woken.wait(lock, [&]() { return ready(stage, j); });
+                --sleepers;
+                break;
+            }
+            return batches[j % slots];
+        }
+
+        // Hands the batch j on from the stage to the next one.
+        void pass(int stage, size_t j) {
+            passed[stage].store(j + 1);
+            if (sleepers.load()) {
+                std::lock_guard<std::mutex> lock(m);
+                woken.notify_all();
+            }
+        }
+
+    private:
+        braidBatch batches[slots];
+        std::atomic<size_t> passed[3];
+        std::atomic<int> sleepers;
+        std::mutex m;
+        std::condition_variable woken;
+
+        bool ready(int stage, size_t j) const {
+            return stage ? (passed[stage - 1].load() > j) :
+                (passed[2].load() + slots > j);
+        }
+};
+
+/* The serial search, with the printing of the braids taken off its
+ * thread: the search deals the braids out in batches to the given number
+ * of worker threads, round-robin and through a ring for each worker. The
+ * workers print them (computing the DT-codes), and a writer thread writes
+ * the printed batches to the output in the order of the search. An empty
+ * batch ends the work of each thread. If stats is not null, the search
+ * tree is counted there. If file is not null, the output goes there
+ * instead of to stdout.
+ */
+template<int MaxB1>
+void pipelineBraids(const searchRules &rules, const outputFormat &format,
+        unsigned workers, searchStats *stats, outputSink *file = 0) {
+    std::vector<batchRing> rings(workers);
+    auto work = [&](batchRing &ring) {
+        dtScratch scratch;
+        for (size_t j = 0; ; ++j) {
+            braidBatch &batch = ring.wait(1, j);
+            const size_t size = batch.size;
+            for (size_t i = 0; i < size; ++i)
+                printResult(batch.braids[i], batch.first + i, scratch,
+                        batch.found, format);
+            ring.pass(1, j);
+            if (size == 0)
+                return;
+        }
+    };
+    auto write = [&]() {
+        outputBuffer out(1, file);
+        if (format.binary)
+            printBinaryHeader(MaxB1 / 2, format, out);
+        // The printed batches have their counters, and no marks.
+        uint64_t counter = 0;
+        for (size_t j = 0; ; ++j) {
+            batchRing &ring = rings.at(j % workers);
+            braidBatch &batch = ring.wait(2, j / workers);
+            const bool last = (batch.size == 0);
+            out.copy(batch.found, counter);
+            batch.found.clear();
+            ring.pass(2, j / workers);
+            if (last)
+                return;
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < workers; ++i)
+        pool.push_back(std::thread(work, std::ref(rings.at(i))));
+    pool.push_back(std::thread(write));
+
+    uint64_t counter = 0;
+    size_t sent = 0;
+    braidBatch *batch = 0;
+    auto take = [&]() {
+        batch = &rings.at(sent % workers).wait(0, sent / workers);
+        batch->size = 0;
+        batch->first = counter + 1;
+    };
+    auto send = [&]() {
+        rings.at(sent % workers).pass(0, sent / workers);
+        ++sent;
+    };
+    auto leaf = [&](const braidWord &b) {
+        batch->braids[batch->size++] = b;
+        ++counter;
+        if (batch->size == braidBatch::capacity) {
+            send();
+            take();
+        }
+    };
+    auto prefix = [](const braidWord &) {};
+    take();
+    searchState<MaxB1> s({ 1, 1 }, rules);
+    searchTree(s, 1, 0, leaf, prefix, stats);
+    if (batch->size) {
+        send();
+        take();
+    }
+    send();
+    for (unsigned i = 1; i < workers; ++i) {
+        take();
+        send();
+    }
+    for (std::vector<std::thread>::iterator i = pool.begin(); i != pool.end();
+            ++i)
+        i->join();
+}
+
+/* Calls visit(letters, n) for every braid of the list of the search of
+ * width MaxB1, in the order in which lb prints them, where letters points
+ * to the n letters of the braid (1 standing for sigma_1, and so on). The
+ * letters are those of the search itself, so they are only valid during
+ * the call.
+ */
+template<int MaxB1, class Visitor>
+void visitBraids(const searchRules &rules, Visitor &visit) {
+    searchState<MaxB1> s({ 1, 1 }, rules);
+    auto leaf = [&](const braidWord &b) { visit(b.data(), b.size()); };
+    auto prefix = [](const braidWord &) {};
+    searchTree(s, 1, 0, leaf, prefix);
+}
+
+// The letters of the text format, a to z (see printBraid() and
+// parseBraid()).
+const int textLetters = 26;
+
+// The highest genus supported, as the longest braids in the search of
+// genus g have 4 * g + 1 letters, and its completable braids (which
+// checkpoints and indices store as text) have letters up to 2 * g + 1.
+const int maxGenus = ((braidWord::capacity - 1) / 4 < (textLetters - 1) / 2) ?
+    (braidWord::capacity - 1) / 4 : (textLetters - 1) / 2;
+// The masks of searchState::positions have a bit for every letter.
+static_assert(braidWord::capacity <= 64, "braidWord is too long.");
+
+// visitBraids<2 * genus>(), returns false if the genus is not between 1
+// and maxGenus.
+template<class Visitor>
+bool visitBraids(int genus, Visitor &visit,
+        const searchRules &rules = searchRules()) {
+    switch (genus) {
+        case 1: visitBraids<2>(rules, visit); return true;
+        case 2: visitBraids<4>(rules, visit); return true;
+        case 3: visitBraids<6>(rules, visit); return true;
+        case 4: visitBraids<8>(rules, visit); return true;
+        case 5: visitBraids<10>(rules, visit); return true;
+        case 6: visitBraids<12>(rules, visit); return true;
+        case 7: visitBraids<14>(rules, visit); return true;
+        case 8: visitBraids<16>(rules, visit); return true;
+        case 9: visitBraids<18>(rules, visit); return true;
+        case 10: visitBraids<20>(rules, visit); return true;
+        case 11: visitBraids<22>(rules, visit); return true;
+        case 12: visitBraids<24>(rules, visit); return true;
+    }
+    return false;
+}
+
+#endif